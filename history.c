@@ -4,6 +4,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
 #include "history.h"
 
 // This is defined in string.h
@@ -13,11 +18,19 @@
 // Command History
 // array of command lines
 // each is associated with a sequence number
+//
+// HISTFILE is shared by every session running as the same user
+// - each command is appended as soon as it is entered, under an
+//   exclusive flock(), and given the next number in the file
+// - a session remembers how much of HISTFILE it has read, and
+//   only reads entries appended by others since then
+// - when HISTFILE grows past HISTFILESIZE lines, the session
+//   exiting replaces it with a copy of its newest HISTFILESIZE lines
 
 #define MAXHIST 20
-#define MAXSTR  200
 
 #define HISTFILE ".mymysh_history"
+#define HISTFILESIZE 500
 
 typedef struct _history_entry {
    int   seqNumber;
@@ -27,77 +40,97 @@ typedef struct _history_entry {
 typedef struct _history_list {
    int nEntries;
    HistoryEntry commands[MAXHIST];
+   char *fileName;   // path of HISTFILE
+   int fd;           // open on HISTFILE, -1 if unavailable
+   off_t offset;     // how much of HISTFILE has been read
+   int fileLines;    // number of lines in HISTFILE
+   int lastSeq;      // highest sequence number seen
 } HistoryList;
 
 // Helper Function prototypes
-static void histFilePath(char *);
-static void mallocMemoryCheck(char *);
+static char *histFilePath(void);
+static void lockHistFile(int);
+static void unlockHistFile(void);
+static void readHistFile(void);
+static int writeAll(int, char *, size_t);
+static void appendEntry(int, char *);
+static void mallocMemoryCheck(void *);
 
 
-HistoryList CommandHistory;
+HistoryList CommandHistory = { .fd = -1 };
 
 // initCommandHistory()
 // - initialise the data structure
 // - read from .history if it exists
+// - returns the sequence number for the next command
 
 int initCommandHistory()
 {
-   FILE *fp;               // stores file pointer from fopen
-   char fileName[MAXSTR];  // path of HISTFILE
-   char line[MAXSTR];      // each line in HISTFILE
-   char cmdLine[MAXSTR];   // stores the command lines from HISTFILE
-   int seqNo;              // stores the sequence numbers from HISTFILE
-   int i;                  // generic index
-   
-   // set up HISTFILE path
-   histFilePath(fileName);
-   
-   // open file for reading
-   if ((fp = fopen(fileName, "r")) == NULL)
+   CommandHistory.nEntries = 0;
+   CommandHistory.offset = 0;
+   CommandHistory.fileLines = 0;
+   CommandHistory.lastSeq = 0;
+
+   // set up HISTFILE path and open it for appending
+   if ((CommandHistory.fileName = histFilePath()) == NULL)
       return 1;
-   
-   // initialise nEntries, i and seqNo to 0
-   CommandHistory.nEntries = i = seqNo = 0;
-   
-   // loop through each line in HISTFILE
-   while (fgets(line, MAXSTR, fp) != NULL) {
-      // parse each line to extract seqNo and command
-      sscanf(line, " %3d  %[^\n]s", &seqNo, cmdLine);
-      CommandHistory.commands[i].seqNumber = seqNo;
-      CommandHistory.commands[i].commandLine = strdup(cmdLine);
-      mallocMemoryCheck(CommandHistory.commands[i].commandLine);
-      i++;
-      CommandHistory.nEntries = i;
-   }
-   fclose(fp);
-   return (seqNo + 1);
+   CommandHistory.fd = open(CommandHistory.fileName, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+   if (CommandHistory.fd < 0)
+      return 1;
+
+   lockHistFile(LOCK_SH);
+   readHistFile();
+   unlockHistFile();
+   return (CommandHistory.lastSeq + 1);
 }
 
 // addToCommandHistory()
-// - add a command line to the history list
+// - add a command line to the history list and to HISTFILE
 // - overwrite oldest entry if buffer is full
+// - returns the sequence number given to the command
 
-void addToCommandHistory(char *cmdLine, int seqNo)
+int addToCommandHistory(char *cmdLine)
 {
-   int numEntries = CommandHistory.nEntries;
-   // handle full buffer
-   if (numEntries == MAXHIST) {
-      // loop through buffer and remove oldest entry
-      for (int i = 0; i < MAXHIST-1; i++) {
-         CommandHistory.commands[i].seqNumber++;
-         free(CommandHistory.commands[i].commandLine);
-         CommandHistory.commands[i].commandLine = strdup(CommandHistory.commands[i+1].commandLine);
-         mallocMemoryCheck(CommandHistory.commands[i].commandLine);
-      }
-      free(CommandHistory.commands[MAXHIST-1].commandLine);
-      numEntries--;
-      CommandHistory.nEntries--;
+   int seqNo;
+
+   if (CommandHistory.fd < 0) {
+      seqNo = ++CommandHistory.lastSeq;
+      appendEntry(seqNo, cmdLine);
+      return seqNo;
    }
-   // add command line to history list
-   CommandHistory.commands[numEntries].seqNumber = seqNo;
-   CommandHistory.commands[numEntries].commandLine = strdup(cmdLine);
-   mallocMemoryCheck(CommandHistory.commands[numEntries].commandLine);
-   CommandHistory.nEntries++;
+
+   // pick up other sessions' commands first, so the number
+   // given to this one follows the last one in HISTFILE
+   lockHistFile(LOCK_EX);
+   readHistFile();
+   seqNo = CommandHistory.lastSeq + 1;
+
+   // O_APPEND and a single write() keep the line in one piece
+   char *line = malloc(strlen(cmdLine) + 32);
+   mallocMemoryCheck(line);
+   int len = sprintf(line, " %3d  %s\n", seqNo, cmdLine);
+   if (write(CommandHistory.fd, line, len) == len) {
+      CommandHistory.offset += len;
+      CommandHistory.fileLines++;
+   }
+   free(line);
+   unlockHistFile();
+
+   CommandHistory.lastSeq = seqNo;
+   appendEntry(seqNo, cmdLine);
+   return seqNo;
+}
+
+// refreshCommandHistory()
+// - read any commands other sessions have added to HISTFILE
+
+void refreshCommandHistory()
+{
+   if (CommandHistory.fd < 0)
+      return;
+   lockHistFile(LOCK_SH);
+   readHistFile();
+   unlockHistFile();
 }
 
 // showCommandHistory()
@@ -128,15 +161,54 @@ char *getCommandFromHistory(int cmdNo)
 }
 
 // saveCommandHistory()
-// - write history to $HOME/.mymysh_history
+// - every command is already in $HOME/.mymysh_history
+// - if the file has grown too long, replace it with its newest
+//   HISTFILESIZE lines (not just the MAXHIST held in memory)
 
 void saveCommandHistory()
 {
-   char fileName[MAXSTR];
-   histFilePath(fileName);
-   FILE *fp = fopen(fileName, "w");
-   showCommandHistory(fp);
-   fclose(fp);
+   if (CommandHistory.fd < 0)
+      return;
+   lockHistFile(LOCK_EX);
+   readHistFile();
+   if (CommandHistory.fileLines <= HISTFILESIZE) {
+      unlockHistFile();
+      return;
+   }
+
+   // readHistFile() has read up to the end of the last complete line
+   size_t size = CommandHistory.offset;
+   char *buf = malloc(size);
+   mallocMemoryCheck(buf);
+   if (pread(CommandHistory.fd, buf, size, 0) != (ssize_t)size) {
+      free(buf);
+      unlockHistFile();
+      return;
+   }
+
+   // find the start of the last HISTFILESIZE lines
+   size_t start = size;
+   int lines = 0;
+   while (start > 0 && !(buf[start-1] == '\n' && lines++ == HISTFILESIZE))
+      start--;
+
+   // write a new copy and rename it over HISTFILE while
+   // holding the lock, so other sessions never see it half done
+   // - O_EXCL so an existing file or symlink is never written through
+   char *tmpName = malloc(strlen(CommandHistory.fileName) + 32);
+   mallocMemoryCheck(tmpName);
+   sprintf(tmpName, "%s.%d", CommandHistory.fileName, (int)getpid());
+   int fd = open(tmpName, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+   if (fd >= 0) {
+      int ok = writeAll(fd, buf + start, size - start) == 0;
+      if (close(fd) == 0 && ok)
+         rename(tmpName, CommandHistory.fileName);
+      else
+         unlink(tmpName);
+   }
+   free(tmpName);
+   free(buf);
+   unlockHistFile();
 }
 
 // cleanCommandHistory
@@ -146,26 +218,148 @@ void cleanCommandHistory()
 {
    for (int i = 0; i < CommandHistory.nEntries; i++)
       free(CommandHistory.commands[i].commandLine);
+   CommandHistory.nEntries = 0;
+   if (CommandHistory.fd >= 0)
+      close(CommandHistory.fd);
+   CommandHistory.fd = -1;
+   free(CommandHistory.fileName);
 }
 
 // Helper Functions
 
 // histFilePath()
-// - assign HISTFILE path to fileName
+// - returns newly allocated HISTFILE path, NULL if $HOME is not set
+
+static char *histFilePath(void)
+{
+   char *home = getenv("HOME");
+   if (home == NULL)
+      return NULL;
+   char *fileName = malloc(strlen(home) + strlen(HISTFILE) + 2);
+   mallocMemoryCheck(fileName);
+   sprintf(fileName, "%s/%s", home, HISTFILE);
+   return fileName;
+}
+
+// lockHistFile()
+// - flock() HISTFILE with op (LOCK_SH or LOCK_EX)
+// - if another session replaced HISTFILE while we waited,
+//   switch to the new file and lock that instead
+
+static void lockHistFile(int op)
+{
+   struct stat held, onDisk;
 
-static void histFilePath(char *fileName)
+   while (CommandHistory.fd >= 0) {
+      if (flock(CommandHistory.fd, op) < 0) {
+         if (errno == EINTR) continue;
+         return;
+      }
+      if (fstat(CommandHistory.fd, &held) < 0
+            || stat(CommandHistory.fileName, &onDisk) < 0
+            || (held.st_dev == onDisk.st_dev && held.st_ino == onDisk.st_ino))
+         return;
+      // the new file keeps the newest entries with their numbers,
+      // so it is read from the start and already-seen entries skipped
+      close(CommandHistory.fd);
+      CommandHistory.fd = open(CommandHistory.fileName, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+      CommandHistory.offset = 0;
+      CommandHistory.fileLines = 0;
+   }
+}
+
+// unlockHistFile()
+// - release the lock taken by lockHistFile()
+
+static void unlockHistFile(void)
+{
+   if (CommandHistory.fd >= 0)
+      flock(CommandHistory.fd, LOCK_UN);
+}
+
+// readHistFile()
+// - read entries added to HISTFILE since it was last read
+// - must be called with HISTFILE locked
+
+static void readHistFile(void)
 {
-   strcpy(fileName, getenv("HOME"));
-   strcat(fileName, "/");
-   strcat(fileName, HISTFILE);
+   struct stat s;
+
+   if (fstat(CommandHistory.fd, &s) < 0 || s.st_size <= CommandHistory.offset)
+      return;
+
+   size_t size = s.st_size - CommandHistory.offset;
+   char *buf = malloc(size + 1);
+   mallocMemoryCheck(buf);
+   ssize_t n = pread(CommandHistory.fd, buf, size, CommandHistory.offset);
+   if (n <= 0) {
+      free(buf);
+      return;
+   }
+   buf[n] = '\0';
+
+   // parse each complete line to extract seqNo and command
+   char *line = buf, *end;
+   while ((end = strchr(line, '\n')) != NULL) {
+      *end = '\0';
+      char *cmdLine;
+      int seqNo = strtol(line, &cmdLine, 10);
+      while (*cmdLine == ' ') cmdLine++;
+      if (cmdLine != line && seqNo > CommandHistory.lastSeq) {
+         appendEntry(seqNo, cmdLine);
+         CommandHistory.lastSeq = seqNo;
+      }
+      CommandHistory.fileLines++;
+      line = end + 1;
+   }
+   CommandHistory.offset += line - buf;
+   free(buf);
+}
+
+// writeAll()
+// - write all len bytes of buf to fd
+// - returns 0 on success, -1 on failure
+
+static int writeAll(int fd, char *buf, size_t len)
+{
+   while (len > 0) {
+      ssize_t n = write(fd, buf, len);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return -1;
+      buf += n;
+      len -= n;
+   }
+   return 0;
+}
+
+// appendEntry()
+// - add an entry to the end of the list, dropping the oldest if full
+
+static void appendEntry(int seqNo, char *cmdLine)
+{
+   if (CommandHistory.nEntries == MAXHIST) {
+      free(CommandHistory.commands[0].commandLine);
+      memmove(
+         &CommandHistory.commands[0],
+         &CommandHistory.commands[1],
+         (MAXHIST-1)*sizeof(HistoryEntry)
+      );
+      CommandHistory.nEntries--;
+   }
+   HistoryEntry *e = &CommandHistory.commands[CommandHistory.nEntries++];
+   e->seqNumber = seqNo;
+   e->commandLine = strdup(cmdLine);
+   mallocMemoryCheck(e->commandLine);
 }
 
 // mallocMemoryCheck()
 // - print error message if malloc failed to allocate memory i.e. NULL
 
-static void mallocMemoryCheck(char *str)
+static void mallocMemoryCheck(void *ptr)
 {
-   if (str == NULL) {
+   if (ptr == NULL) {
       fprintf(stderr, "Failed to allocate memory using malloc.\n");
       exit(0);
    }
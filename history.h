@@ -6,7 +6,8 @@
 // Functions on the Command History object
 
 int initCommandHistory();
-void addToCommandHistory(char *cmdLine, int seqNo);
+int addToCommandHistory(char *cmdLine);
+void refreshCommandHistory();
 void showCommandHistory(FILE *histFile);
 char *getCommandFromHistory(int cmdNo);
 void saveCommandHistory();
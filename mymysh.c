@@ -14,7 +14,11 @@
 #include <glob.h>
 #include <assert.h>
 #include <fcntl.h>
+#include <errno.h>
 #include "history.h"
+#include "outlog.h"
+#include "workdir.h"
+#include "watchdog.h"
 
 // This is defined in string.h
 // BUT ONLY if you use -std=gnu99
@@ -23,22 +27,28 @@
 // Function forward references
 
 void trim(char *);
+int runCommand(char *, char **, char **);
+char **commandList(char *);
+int exitStatus(int, int);
 char **tokenise(char *, char *);
 char **fileNameExpand(char **);
 void freeTokens(char **);
 char *findExecutable(char *, char **);
 int isExecutable(char *);
 int shellBuiltIn(char *, char *);
+int timeoutCommand(char **, double *);
 int redirection(FILE **, char **);
 void pwd(void);
 int cd(char *);
+int cdPath(char *);
+int printDirs(char *, int);
 int errorPath(char, char *);
 int pathExists(char *);
 int isDir(char *);
 int readPerm(char *);
 int writePerm(char *);
 void printExe(char *exe);
-void printReturn(int);
+void printReturn(int, int);
 void errorExit(char *);
 void tokenMemoryErrorCheck(char **, char *);
 void prompt(void);
@@ -58,17 +68,11 @@ void prompt(void);
 
 int main(int argc, char *argv[], char *envp[])
 {
-   pid_t pid;   // pid of child process
-   int p[2];   // pipe file descriptor
-   int stat;   // return status of child
-   int built_in;  // return status of shellBuiltIn
-   int redirect;  // return status of redirection
    char **path;   // array of directory names
-   char **tok_line;  // tokenised command line
-   char *exe;  // name of command
-   char file_str[MAXLINE];   // stores each line of a file
-   FILE *fp;   // file pointer for input/output redirection
+   char **cmd_list;  // commands and connectors in the line
+   int status;  // exit status of last command run, -1 for "exit"
    int cmdNo;  // command number
+   int lineNo;  // history sequence number of this line
    int seqNo;  // sequence number in HISTFILE
    int i;       // generic index
 
@@ -86,11 +90,25 @@ int main(int argc, char *argv[], char *envp[])
       printf("path[%d] = %s\n",i,path[i]);
 #endif
 
+   // record the current working directory
+
+   if (initWorkingDir() < 0)
+      errorExit("getcwd() failed");
+
+   // run children in their own process groups under a watchdog
+
+   if (initWatchdog() < 0)
+      errorExit("initWatchdog() failed");
+
    // initialise command history
    // - use content of ~/.mymysh_history file if it exists
 
    cmdNo = initCommandHistory();
 
+   // open session output log if $MYMYSH_OUTLOG is set
+
+   initOutputLog();
+
    // main loop: print prompt, read line, execute command
 
    char line[MAXLINE];
@@ -124,100 +142,45 @@ int main(int argc, char *argv[], char *envp[])
          }
       }
 
-      // tokenise the command line
-      tok_line = tokenise(line, " ");
-
-      // handle *?[~ filename expansion
-      tok_line = fileNameExpand(tok_line);
-
-      // handle shell built-ins
-      built_in = shellBuiltIn(tok_line[0], tok_line[1]);
-      if (built_in == 1) { freeTokens(tok_line); break; } // terminate shell if "exit" command
-      if (built_in == 2) { freeTokens(tok_line); prompt(); continue; } // continue if cd to invalid dir
-      
-      // handle program execution
-      if (!built_in) {
-         // check for input/output redirections
-         if ((redirect = redirection(&fp, tok_line)) < 0) {
-            freeTokens(tok_line);
-            prompt();
-            continue; 
-         }
-
-         // check if executable is found
-         if ((exe = findExecutable(tok_line[0], path)) == NULL) {
-            printf("%s: Command not found\n", tok_line[0]);
-            free(exe);
-            freeTokens(tok_line);
-            prompt();
-            continue;
-         }
+      // add to command history
+      // - done before running so the line gets its number now,
+      //   even if other sessions are adding to history meanwhile
+      lineNo = addToCommandHistory(line);
+      cmdNo = lineNo+1;
+
+      // split the line into commands joined by ";", "&&" and "||"
+      if ((cmd_list = commandList(line)) == NULL) {
+         printf("Invalid command list\n");
+         prompt();
+         continue;
+      }
 
-         // create a pipe
-         if (pipe(p) == -1)
-            errorExit("pipe() failed");
-         
-         // create a child process
-         pid = fork();
-         if (pid > 0) { // parent process
-            // sort out any redirections
-            if (redirect > 0) {
-               if (redirect == 1) {
-                  close(p[0]);
-                  // write from file to p[1]
-                  while (fgets(file_str, MAXLINE, fp) != NULL)
-                     write(p[1], file_str, strlen(file_str));
-                  close(p[1]);
-               }
-               fclose(fp);
-            }
-            
-            // parent shell process waits for child to complete
-            wait(&stat);
-            
-            // print command return status
-            printReturn(stat);
-         } else if (pid == 0) { // child process
-            // print pathname of command executable
-            printExe(exe);
-            
-            // sort out input redirection
-            if (redirect == 1) {
-               // copy p[0] to stdin
-               if (dup2(p[0], 0) < 0)
-                  errorExit("dup2() failed");
-               close(p[1]);
-            }
-            
-            // sort out output redirection
-            if (redirect == 2) {
-               // copy fileno(fp) to stdout and stderr
-               if (dup2(fileno(fp), 1) < 0 || dup2(fileno(fp), 2) < 0)
-                  errorExit("dup2() failed");
-               close(fileno(fp));
-            }
-            
-            // execute exe
-            if (execve(exe, tok_line, envp) == -1) {
-               fprintf(stderr, "%s: unknown type of executable\n", exe);
-               exit(255);
-            }
-         } else {
-            errorExit("fork() failed");
-         }
-         free(exe);
+      // run each command in turn
+      // - "&&" runs the next command only if the last one succeeded
+      // - "||" runs the next command only if the last one failed
+      // - commands are at even indexes, connectors at odd ones
+      // - output from the whole line is logged as one entry
+      status = 0;
+      beginOutputEntry(lineNo);
+      for (i = 0; cmd_list[i] != NULL; i++) {
+         if (i % 2 == 1) continue;
+         if (i > 0 && strcmp(cmd_list[i-1], "&&") == 0 && status != 0) continue;
+         if (i > 0 && strcmp(cmd_list[i-1], "||") == 0 && status == 0) continue;
+         if ((status = runCommand(cmd_list[i], path, envp)) < 0) break;
       }
-      // add to command history
-      addToCommandHistory(line, cmdNo);
+      endOutputEntry();
+      // report the status of the list as a whole if it had several commands
+      if (status >= 0 && i > 1)
+         printf("List returns %d\n", status);
 
-      // free memory allocated to tok_line
-      freeTokens(tok_line);
+      // free memory allocated to cmd_list
+      freeTokens(cmd_list);
+      
+      // terminate shell if "exit" command
+      if (status < 0) break;
 
       // print another prompt
       prompt();
-
-      // iterate cmdNo
-      cmdNo++;
    }
    // free memory allocated to path
    freeTokens(path);
@@ -226,10 +189,208 @@ int main(int argc, char *argv[], char *envp[])
    saveCommandHistory();
    cleanCommandHistory();
    
+   // close session output log
+   cleanOutputLog();
+   
+   // clean up working directory and directory stack
+   cleanWorkingDir();
+   
+   // close watchdog
+   cleanWatchdog();
+   
    printf("\n");
    return(EXIT_SUCCESS);
 }
 
+// runCommand: run a single command from a command list
+// - return the command's exit status, or -1 if it was "exit"
+int runCommand(char *cmdLine, char **path, char **envp)
+{
+   pid_t pid;   // pid of child process
+   int cap[2];   // stdout capture pipe, cap[0] = -1 if not capturing
+   int errCap[2];   // stderr capture pipe, errCap[0] = -1 if not capturing
+   int stat;   // return status of child
+   int status = 0;   // exit status of command
+   int killSig;   // signal sent to child on timeout, 0 if none
+   double limit;  // time limit for command in seconds, 0 if none
+   int built_in;  // return status of shellBuiltIn
+   int redirect;  // return status of redirection
+   char **tok_line;  // tokenised command line
+   char *exe;  // name of command
+   FILE *fp;   // file pointer for input/output redirection
+
+   // tokenise the command line
+   tok_line = tokenise(cmdLine, " ");
+
+   // handle *?[~ filename expansion
+   tok_line = fileNameExpand(tok_line);
+
+   // handle "timeout DURATION" prefix or session default
+   limit = getDefaultTimeout();
+   if (strcmp(tok_line[0], "timeout") == 0) {
+      built_in = timeoutCommand(tok_line, &limit);
+      if (built_in) { freeTokens(tok_line); return built_in == 3 ? 0 : 1; }
+   }
+
+   // handle shell built-ins
+   built_in = shellBuiltIn(tok_line[0], tok_line[1]);
+   if (built_in == 1) { freeTokens(tok_line); return -1; } // terminate shell if "exit" command
+   if (built_in == 2) { freeTokens(tok_line); return 1; } // fail if cd to invalid dir
+   
+   // handle program execution
+   if (!built_in) {
+      // check for input/output redirections
+      if ((redirect = redirection(&fp, tok_line)) < 0) {
+         freeTokens(tok_line);
+         return 1;
+      }
+
+      // check if executable is found
+      if ((exe = findExecutable(tok_line[0], path)) == NULL) {
+         printf("%s: Command not found\n", tok_line[0]);
+         free(exe);
+         freeTokens(tok_line);
+         return 127;
+      }
+
+      // capture output for the session log unless it goes to a file
+      // - stdout and stderr get a pipe each, so they stay apart
+      cap[0] = errCap[0] = -1;
+      if (outputLogEnabled() && redirect != 2) {
+         if ((cap[0] = openOutputCapture(&cap[1])) < 0
+               || (errCap[0] = openOutputCapture(&errCap[1])) < 0)
+            errorExit("pipe() failed");
+      }
+      
+      // create a child process
+      // - flush first so the child does not inherit pending output
+      fflush(stdout);
+      pid = fork();
+      if (pid > 0) { // parent process
+         // the child holds its own copy of any redirection file
+         if (redirect > 0)
+            fclose(fp);
+         
+         // parent shell process waits for child to complete
+         // - copying captured output to the terminal and the log
+         // - killing it if it runs past its time limit
+         if (cap[0] >= 0) {
+            close(cap[1]);
+            close(errCap[1]);
+         }
+         killSig = waitForChild(pid, limit, cap[0], errCap[0], &stat);
+         if (cap[0] >= 0) {
+            close(cap[0]);
+            close(errCap[0]);
+         }
+         
+         // print command return status
+         printReturn(stat, killSig);
+         status = exitStatus(stat, killSig);
+      } else if (pid == 0) { // child process
+         // move into own process group for the watchdog
+         prepareWatchedChild();
+         
+         // print pathname of command executable
+         printExe(exe);
+         fflush(stdout);
+         
+         // sort out input redirection
+         if (redirect == 1) {
+            // copy fileno(fp) to stdin
+            if (dup2(fileno(fp), 0) < 0)
+               errorExit("dup2() failed");
+            close(fileno(fp));
+         }
+         
+         // sort out output redirection
+         if (redirect == 2) {
+            // copy fileno(fp) to stdout and stderr
+            if (dup2(fileno(fp), 1) < 0 || dup2(fileno(fp), 2) < 0)
+               errorExit("dup2() failed");
+            close(fileno(fp));
+         }
+         
+         // send stdout and stderr through their capture pipes
+         if (cap[0] >= 0) {
+            if (dup2(cap[1], 1) < 0 || dup2(errCap[1], 2) < 0)
+               errorExit("dup2() failed");
+         }
+         
+         // execute exe
+         if (execve(exe, tok_line, envp) == -1) {
+            fprintf(stderr, "%s: unknown type of executable\n", exe);
+            exit(255);
+         }
+      } else {
+         errorExit("fork() failed");
+      }
+      free(exe);
+   }
+   // free memory allocated to tok_line
+   freeTokens(tok_line);
+   return status;
+}
+
+// commandList: split a line into commands joined by ";", "&&" and "||"
+// - returns commands and connectors alternately, e.g. "a && b" gives
+//   {"a", "&&", "b", NULL}, or NULL if a command is missing
+// - a single trailing ";" is allowed and dropped
+char **commandList(char *line)
+{
+   int n = 0, max = 8;
+   char **list = malloc(max*sizeof(char *));
+   tokenMemoryErrorCheck(list, "malloc()");
+   char *start = line, *s = line;
+   while (1) {
+      int oplen = 0;
+      if (*s == ';')
+         oplen = 1;
+      else if ((s[0] == '&' && s[1] == '&') || (s[0] == '|' && s[1] == '|'))
+         oplen = 2;
+      if (oplen == 0 && *s != '\0') { s++; continue; }
+
+      // make room for a command, a connector and the final NULL
+      if (n+3 > max) {
+         max *= 2;
+         list = realloc(list, max*sizeof(char *));
+         tokenMemoryErrorCheck(list, "realloc()");
+      }
+      char *cmd = strndup(start, s - start);
+      if (cmd == NULL) errorExit("strndup() failed");
+      trim(cmd);
+      if (cmd[0] == '\0') {
+         free(cmd);
+         list[n] = NULL;
+         if (*s != '\0' || n == 0 || strcmp(list[n-1], ";") != 0) {
+            freeTokens(list);
+            return NULL;
+         }
+         free(list[--n]);
+         break;
+      }
+      list[n++] = cmd;
+      if (*s == '\0') break;
+      if ((list[n++] = strndup(s, oplen)) == NULL)
+         errorExit("strndup() failed");
+      s += oplen;
+      start = s;
+   }
+   list[n] = NULL;
+   return list;
+}
+
+// exitStatus: convert a child's wait status to a shell exit status
+// - 124 if the watchdog timed it out, 128+N if killed by signal N
+int exitStatus(int stat, int killSig)
+{
+   if (killSig)
+      return 124;
+   if (WIFSIGNALED(stat))
+      return 128 + WTERMSIG(stat);
+   return WEXITSTATUS(stat);
+}
+
 // fileNameExpand: expand any wildcards in command-line args
 // - returns a possibly larger set of tokens
 char **fileNameExpand(char **tokens)
@@ -272,15 +433,21 @@ char **fileNameExpand(char **tokens)
 }
 
 // shellBuiltIn: Handle shell built-in commands
-// - return 1 if "exit" command, 2 if cd fails, 3 if other shell built-in command, 0 otherwise
+// - return 1 if "exit" command, 2 if cd/pushd/popd fails, 3 if other shell built-in command, 0 otherwise
 int shellBuiltIn(char *cmd, char *arg)
 {
+   int seqNo;
+
    // "exit" command
    if (strcmp(cmd, "exit") == 0)
       return 1;
    // "h" or "history" command
+   // - "history -r" reads commands added by other sessions
    if ((strcmp(cmd, "h") == 0) || (strcmp(cmd, "history") == 0)) {
-      showCommandHistory(stdout);
+      if (arg != NULL && strcmp(arg, "-r") == 0)
+         refreshCommandHistory();
+      else
+         showCommandHistory(stdout);
       return 3;
    }
    // "pwd" command
@@ -291,6 +458,59 @@ int shellBuiltIn(char *cmd, char *arg)
    // "cd" command
    if (strcmp(cmd, "cd") == 0)
       return cd(arg);
+   // "pushd", "popd" and "dirs" commands
+   if (strcmp(cmd, "pushd") == 0)
+      return printDirs(arg == NULL ? cmd : arg, pushWorkingDir(arg));
+   if (strcmp(cmd, "popd") == 0)
+      return printDirs(cmd, popWorkingDir());
+   if (strcmp(cmd, "dirs") == 0) {
+      showDirStack(stdout);
+      return 3;
+   }
+   // "output" command
+   if (strcmp(cmd, "output") == 0) {
+      if (!outputLogEnabled())
+         printf("output: Session log is not enabled\n");
+      else if (arg == NULL || sscanf(arg, "%d", &seqNo) != 1)
+         printf("output: Usage: output N\n");
+      else if (!showOutput(seqNo, stdout))
+         printf("No output for command #%d\n", seqNo);
+      return 3;
+   }
+   return 0;
+}
+
+// timeoutCommand: handle the "timeout" built-in
+// - "timeout" shows the session time limit, "timeout DURATION" sets it
+// - "timeout DURATION cmd ..." strips the prefix from tokens and
+//   sets *limit, so that cmd is run with that time limit
+// - return 0 if tokens now hold a command to run, 2 if invalid, 3 otherwise
+int timeoutCommand(char **tokens, double *limit)
+{
+   double secs;
+   int i;
+   if (tokens[1] == NULL) {
+      if ((secs = getDefaultTimeout()) > 0)
+         printf("timeout: Commands are limited to %gs\n", secs);
+      else
+         printf("timeout: No time limit\n");
+      return 3;
+   }
+   if (parseDuration(tokens[1], &secs) < 0) {
+      printf("timeout: Invalid duration %s\n", tokens[1]);
+      return 2;
+   }
+   if (tokens[2] == NULL) {
+      setDefaultTimeout(secs);
+      return 3;
+   }
+   // shift cmd ... down over "timeout DURATION"
+   free(tokens[0]);
+   free(tokens[1]);
+   for (i = 2; tokens[i] != NULL; i++)
+      tokens[i-2] = tokens[i];
+   tokens[i-2] = NULL;
+   *limit = secs;
    return 0;
 }
 
@@ -359,25 +579,18 @@ int redirection(FILE **fp, char **tokens) {
 // findExecutable: look for executable in PATH
 char *findExecutable(char *cmd, char **path)
 {
-   char executable[MAXLINE];
-   executable[0] = '\0';
-   if (cmd[0] == '/' || cmd[0] == '.') {
-      strcpy(executable, cmd);
-      if (!isExecutable(executable))
-         executable[0] = '\0';
-   } 
-   else {
-      int i;
-      for (i = 0; path[i] != NULL; i++) {
-         sprintf(executable, "%s/%s", path[i], cmd);
-         if (isExecutable(executable)) break;
-      }
-      if (path[i] == NULL) executable[0] = '\0';
+   char *executable;
+   if (cmd[0] == '/' || cmd[0] == '.')
+      return isExecutable(cmd) ? strdup(cmd) : NULL;
+   for (int i = 0; path[i] != NULL; i++) {
+      executable = malloc(strlen(path[i]) + strlen(cmd) + 2);
+      assert(executable != NULL);
+      sprintf(executable, "%s/%s", path[i], cmd);
+      if (isExecutable(executable))
+         return executable;
+      free(executable);
    }
-   if (executable[0] == '\0')
-      return NULL;
-   else
-      return strdup(executable);
+   return NULL;
 }
 
 // isExecutable: check whether this process can execute a file
@@ -385,7 +598,7 @@ int isExecutable(char *cmd)
 {
    struct stat s;
    // must be accessible
-   if (stat(cmd, &s) < 0)
+   if (fstatat(getWorkingDirFd(), cmd, &s, 0) < 0)
       return 0;
    // must be a regular file
    //if (!(s.st_mode & S_IFREG))
@@ -446,7 +659,7 @@ void trim(char *str)
    first = 0;
    while (isspace(str[first])) first++;
    last  = strlen(str)-1;
-   while (isspace(str[last])) last--;
+   while (last >= first && isspace(str[last])) last--;
    int i, j = 0;
    for (i = first; i <= last; i++) str[j++] = str[i];
    str[j] = '\0';
@@ -455,41 +668,83 @@ void trim(char *str)
 // pwd: print current working directory
 void pwd(void)
 {
-   char wd[MAXLINE];
-   if (getcwd(wd, sizeof(wd)) != NULL)
-      printf("%s\n", wd);
-   else
-      errorExit("getcwd() failed");
+   printf("%s\n", getWorkingDir());
 }
 
 // cd: change directories and print new working directory
+// - "cd" goes to $HOME, "cd -" to the previous directory
+// - relative names are searched for along $CDPATH first
 int cd(char *arg)
 {
-   char wd[MAXLINE];
-   // get current working directory
-   if (getcwd(wd, sizeof(wd)) != NULL) {
-      // set wd to the new working directory
-      if (arg == NULL) {
-         strcpy(wd, getenv("HOME"));
-      } else if (arg[0] == '/') {
-         strcpy(wd, arg);
-      } else {
-         strcat(wd, "/");
-         strcat(wd, arg);
+   char *dir = arg;
+   if (arg == NULL) {
+      if ((dir = getenv("HOME")) == NULL) {
+         printf("cd: HOME not set\n");
+         return 2;
       }
-      // change to new working directory
-      if (chdir(wd) == 0) {
-         pwd();
-      } else {
-         printf("%s: No such file or directory\n", arg);
+   } else if (strcmp(arg, "-") == 0) {
+      if ((dir = getOldWorkingDir()) == NULL) {
+         printf("cd: OLDPWD not set\n");
          return 2;
       }
-   } else {
-      errorExit("getcwd() failed");
+   } else if (cdPath(arg)) {
+      pwd();
+      return 3;
    }
+   // change to new working directory
+   if (changeWorkingDir(dir) < 0) {
+      printf("%s: %s\n", dir, strerror(errno));
+      return 2;
+   }
+   pwd();
    return 3;
 }
 
+// cdPath: try each directory in $CDPATH as a prefix for arg
+// - return 1 if the working directory was changed, 0 otherwise
+int cdPath(char *arg)
+{
+   char *cdpath = getenv("CDPATH");
+   // CDPATH does not apply to absolute or explicitly relative names
+   if (cdpath == NULL || arg[0] == '/' || strcmp(arg, ".") == 0 || strcmp(arg, "..") == 0
+         || strncmp(arg, "./", 2) == 0 || strncmp(arg, "../", 3) == 0)
+      return 0;
+   char *dir = malloc(strlen(cdpath) + strlen(arg) + 2);
+   assert(dir != NULL);
+   while (1) {
+      // an empty entry means the current directory
+      size_t len = strcspn(cdpath, ":");
+      if (len == 0)
+         sprintf(dir, "%s", arg);
+      else
+         sprintf(dir, "%.*s/%s", (int)len, cdpath, arg);
+      if (changeWorkingDir(dir) == 0) {
+         free(dir);
+         return 1;
+      }
+      if (cdpath[len] == '\0') break;
+      cdpath += len+1;
+   }
+   free(dir);
+   return 0;
+}
+
+// printDirs: report the outcome of pushd/popd
+// - print the directory stack on success, an error message otherwise
+// - return 3 on success, 2 on failure, as for cd
+int printDirs(char *name, int status)
+{
+   if (status == 0) {
+      showDirStack(stdout);
+      return 3;
+   }
+   if (status == -2)
+      printf("%s: Directory stack empty\n", name);
+   else
+      printf("%s: %s\n", name, strerror(errno));
+   return 2;
+}
+
 int errorPath(char c, char *path) {
    // handle input redirection path errors
    if (c == '<') {
@@ -506,15 +761,10 @@ int errorPath(char c, char *path) {
    }
    // handle output redirection path errors
    if (c == '>') {
-      // check for write permissions
-      char wd[MAXLINE];
-      if (getcwd(wd, sizeof(wd)) != NULL) {
-         if (!writePerm(wd)) {
-            printf("Output redirection: Permission denied\n");
-            return 1;       
-         }
-      } else {
-         errorExit("getcwd() failed");
+      // check for write permissions on the working directory
+      if (!writePerm(".")) {
+         printf("Output redirection: Permission denied\n");
+         return 1;
       }
       // check if path exists
       if (!pathExists(path)) {
@@ -528,7 +778,7 @@ int errorPath(char c, char *path) {
 // pathExists: check if a path exists
 // - return 1 if exists, 0 otherwise
 int pathExists(char *path) {
-   if (access(path, F_OK) != -1)
+   if (faccessat(getWorkingDirFd(), path, F_OK, 0) != -1)
       return 1;
    return 0;
 }
@@ -537,7 +787,7 @@ int pathExists(char *path) {
 // - return non-zero if path is a directory, 0 if path is not a directory
 int isDir(char *path) {
    struct stat s;
-   if (stat(path, &s) != 0)
+   if (fstatat(getWorkingDirFd(), path, &s, 0) != 0)
       return 0;
    return S_ISDIR(s.st_mode);
 }
@@ -545,7 +795,7 @@ int isDir(char *path) {
 // readPerm: check if path has read permissions
 // - return 1 if has read permissions, 0 otherwise
 int readPerm(char *path) {
-   if (access(path, R_OK) != -1)
+   if (faccessat(getWorkingDirFd(), path, R_OK, 0) != -1)
       return 1;
    return 0;
 }
@@ -553,7 +803,7 @@ int readPerm(char *path) {
 // writePerm: check if path has write permissions
 // - return 1 if has write permissions, 0 otherwise
 int writePerm(char *path) {
-   if (access(path, W_OK) != -1)
+   if (faccessat(getWorkingDirFd(), path, W_OK, 0) != -1)
       return 1;
    return 0;
 }
@@ -565,9 +815,18 @@ void printExe(char *exe)
 }
 
 // printReturn: print the command's return status
-void printReturn(int stat)
+// - killSig is the last signal the watchdog sent, 0 if it did not time out
+void printReturn(int stat, int killSig)
 {
-   printf("--------------------\nReturns %d\n", WEXITSTATUS(stat));
+   printf("--------------------\n");
+   if (killSig && WIFSIGNALED(stat))
+      printf("Timed out, killed by signal %d (%s)\n", WTERMSIG(stat), strsignal(WTERMSIG(stat)));
+   else if (killSig)
+      printf("Timed out, sent signal %d (%s), returns %d\n", killSig, strsignal(killSig), WEXITSTATUS(stat));
+   else if (WIFSIGNALED(stat))
+      printf("Killed by signal %d (%s)\n", WTERMSIG(stat), strsignal(WTERMSIG(stat)));
+   else
+      printf("Returns %d\n", WEXITSTATUS(stat));
 }
 
 // errorExit: print error message and exits the program
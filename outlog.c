@@ -0,0 +1,425 @@
+// COMP1521 18s2 mymysh ... session output log
+// Implements an abstract data object
+
+// splice(), tee() and loff_t are only available with _GNU_SOURCE
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include "outlog.h"
+
+// Output Log
+// append-only file holding the output of every command run while
+// the log is enabled, by this session and by any other session
+// given the same $MYMYSH_OUTLOG, plus an index file beside it
+// ($MYMYSH_OUTLOG.idx) recording where each command's output went
+// - each chunk of output gets a region at the end of the log,
+//   reserved by extending the file under a short flock(), so
+//   sessions never write over each other
+// - the index holds one line per chunk, "seq pid offset length",
+//   appended with a single write() once the chunk is in the log;
+//   a line with length 0 marks the start of a command's output
+// - history sequence numbers are shared by all sessions, so
+//   "output N" finds command N whichever session ran it
+
+#define LOGENV   "MYMYSH_OUTLOG"
+#define INDEXEXT ".idx"
+#define PUMPSIZE (64*1024)
+#define COPYSIZE 4096
+
+typedef struct _output_chunk {
+   loff_t offset;
+   loff_t length;
+} OutputChunk;
+
+typedef struct _output_log {
+   int fd;              // log file, -1 if logging disabled
+   int indexFd;         // index file, opened for appending
+   int teePipe[2];      // pipe used to duplicate captured output
+   int writeFailed;     // 1 once a write to the log has failed
+   int seqNumber;       // command whose output is being logged
+   int pid;             // this session, to tell its index lines apart
+} OutputLog;
+
+// Helper Function prototypes
+static int reserveLog(size_t, loff_t *);
+static void addIndexLine(loff_t, loff_t);
+static void sendRegion(FILE *, loff_t, size_t);
+static int spliceAll(int, int, loff_t *, size_t);
+static int copyAll(int, int, loff_t *, size_t);
+static void discardAll(int, size_t);
+static void logWriteFailed(void);
+static void mallocMemoryCheck(void *);
+
+
+OutputLog SessionOutput = { .fd = -1 };
+
+// initOutputLog()
+// - open the log named by $MYMYSH_OUTLOG, if it is set, and its index
+// - new output is added after anything already in the log
+// - returns 1 if logging is enabled, 0 otherwise
+
+int initOutputLog()
+{
+   char *fileName = getenv(LOGENV);
+
+   if (fileName == NULL || fileName[0] == '\0')
+      return 0;
+
+   // splice() refuses O_APPEND files, so the log is opened
+   // normally and every write goes to an explicit offset
+   SessionOutput.fd = open(fileName, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+   if (SessionOutput.fd < 0) {
+      perror(fileName);
+      return 0;
+   }
+   char *indexName = malloc(strlen(fileName) + strlen(INDEXEXT) + 1);
+   mallocMemoryCheck(indexName);
+   sprintf(indexName, "%s%s", fileName, INDEXEXT);
+   SessionOutput.indexFd = open(indexName, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+   if (SessionOutput.indexFd < 0)
+      perror(indexName);
+   free(indexName);
+   if (SessionOutput.indexFd < 0 || pipe2(SessionOutput.teePipe, O_CLOEXEC) < 0) {
+      if (SessionOutput.indexFd >= 0) {
+         perror("pipe() failed");
+         close(SessionOutput.indexFd);
+      }
+      close(SessionOutput.fd);
+      SessionOutput.fd = -1;
+      return 0;
+   }
+   SessionOutput.writeFailed = 0;
+   SessionOutput.seqNumber = 0;
+   SessionOutput.pid = getpid();
+   return 1;
+}
+
+// outputLogEnabled()
+// - returns 1 if child output is being logged, 0 otherwise
+
+int outputLogEnabled()
+{
+   return SessionOutput.fd >= 0;
+}
+
+// openOutputCapture()
+// - create the pipe that sits between a child and the terminal
+// - the write end is returned in *writeFd for the child
+// - returns the read end, or -1 if the pipe could not be made
+
+int openOutputCapture(int *writeFd)
+{
+   int p[2];
+   if (pipe2(p, O_CLOEXEC) < 0)
+      return -1;
+   *writeFd = p[1];
+   return p[0];
+}
+
+// pumpOutputCapture()
+// - move the next chunk of captured output to termFd (the shell's
+//   stdout or stderr, whichever the child wrote to) and the log
+// - data is duplicated with tee() and moved with splice(),
+//   so it never passes through a userspace buffer
+// - if the log cannot be written, the output still goes to the
+//   terminal so the child is never left blocked on a full pipe
+// - returns number of bytes moved, 0 at end of output, -1 on error
+
+int pumpOutputCapture(int readFd, int termFd)
+{
+   ssize_t n;
+   loff_t off, start;
+
+   // duplicate whatever is in the capture pipe into teePipe
+   do {
+      n = tee(readFd, SessionOutput.teePipe[1], PUMPSIZE, 0);
+   } while (n < 0 && errno == EINTR);
+   if (n == 0)
+      return 0;
+   if (n < 0) {
+      // tee() failed: fall back to copying via userspace
+      char buf[COPYSIZE];
+      if ((n = read(readFd, buf, sizeof(buf))) <= 0)
+         return n;
+      if (write(termFd, buf, n) < 0) { /* keep logging */ }
+      if (reserveLog(n, &off) == 0 && pwrite(SessionOutput.fd, buf, n, off) == n)
+         addIndexLine(off, n);
+      else
+         logWriteFailed();
+      return n;
+   }
+
+   // the copy goes to the terminal, the original goes to the log
+   // - the n bytes are taken out of the pipe even if the log fails
+   spliceAll(SessionOutput.teePipe[0], termFd, NULL, n);
+   if (reserveLog(n, &off) < 0) {
+      discardAll(readFd, n);
+      logWriteFailed();
+      return n;
+   }
+   start = off;
+   if (spliceAll(readFd, SessionOutput.fd, &off, n) < 0)
+      logWriteFailed();
+   else
+      addIndexLine(start, n);
+   return n;
+}
+
+// discardOutputCapture()
+// - read the next chunk of captured output and throw it away,
+//   for when it can no longer be copied
+// - returns number of bytes read, 0 at end of output, -1 on error
+
+int discardOutputCapture(int readFd)
+{
+   char buf[COPYSIZE];
+   return read(readFd, buf, sizeof(buf));
+}
+
+// beginOutputEntry()
+// - log output from now on as belonging to command seqNo
+// - its start is marked in the index even if it has no output
+
+void beginOutputEntry(int seqNo)
+{
+   if (!outputLogEnabled())
+      return;
+   SessionOutput.seqNumber = seqNo;
+   addIndexLine(0, 0);
+}
+
+// endOutputEntry()
+// - finish logging output for the current command
+
+void endOutputEntry()
+{
+   SessionOutput.seqNumber = 0;
+}
+
+// showOutput()
+// - replay the logged output of command seqNo to outf
+// - returns 1 if the command's output was found, 0 otherwise
+
+int showOutput(int seqNo, FILE *outf)
+{
+   struct stat s;
+   int nChunks = 0, maxChunks = 0, pid = 0, found = 0;
+   OutputChunk *chunks = NULL;
+
+   if (fstat(SessionOutput.indexFd, &s) < 0 || s.st_size == 0)
+      return 0;
+   char *buf = malloc(s.st_size + 1);
+   mallocMemoryCheck(buf);
+   ssize_t size = pread(SessionOutput.indexFd, buf, s.st_size, 0);
+   if (size <= 0) {
+      free(buf);
+      return 0;
+   }
+   buf[size] = '\0';
+
+   // collect the chunks of the latest run of seqNo, in order
+   // - a start line resets the list, so if seqNo was reused
+   //   the most recent command wins
+   char *line = buf, *end;
+   while ((end = strchr(line, '\n')) != NULL) {
+      int seq, linePid;
+      long long offset, length;
+      *end = '\0';
+      if (sscanf(line, "%d %d %lld %lld", &seq, &linePid, &offset, &length) == 4
+            && seq == seqNo) {
+         if (length == 0) {
+            nChunks = 0;
+            pid = linePid;
+            found = 1;
+         } else if (found && linePid == pid) {
+            if (nChunks == maxChunks) {
+               maxChunks = maxChunks ? 2*maxChunks : 16;
+               chunks = realloc(chunks, maxChunks*sizeof(OutputChunk));
+               mallocMemoryCheck(chunks);
+            }
+            chunks[nChunks].offset = offset;
+            chunks[nChunks].length = length;
+            nChunks++;
+         }
+      }
+      line = end + 1;
+   }
+   free(buf);
+
+   fflush(outf);
+   for (int i = 0; i < nChunks; i++)
+      sendRegion(outf, chunks[i].offset, chunks[i].length);
+   free(chunks);
+   return found;
+}
+
+// cleanOutputLog()
+// - close the log and its index
+
+void cleanOutputLog()
+{
+   if (!outputLogEnabled())
+      return;
+   close(SessionOutput.teePipe[0]);
+   close(SessionOutput.teePipe[1]);
+   close(SessionOutput.indexFd);
+   close(SessionOutput.fd);
+   SessionOutput.fd = -1;
+}
+
+// Helper Functions
+
+// reserveLog()
+// - claim len bytes at the end of the log for this session
+// - the file is extended while holding an exclusive flock(),
+//   so no other session can be given the same region
+// - stores the region's offset in *off
+// - returns 0 on success, -1 on failure
+
+static int reserveLog(size_t len, loff_t *off)
+{
+   struct stat s;
+   int status = -1;
+
+   while (flock(SessionOutput.fd, LOCK_EX) < 0)
+      if (errno != EINTR)
+         return -1;
+   if (fstat(SessionOutput.fd, &s) == 0 && ftruncate(SessionOutput.fd, s.st_size + len) == 0) {
+      *off = s.st_size;
+      status = 0;
+   }
+   flock(SessionOutput.fd, LOCK_UN);
+   return status;
+}
+
+// addIndexLine()
+// - record that the current command has length bytes at offset
+// - O_APPEND and a single write() keep the line in one piece
+
+static void addIndexLine(loff_t offset, loff_t length)
+{
+   char line[96];
+   int len = snprintf(line, sizeof(line), "%d %d %lld %lld\n",
+      SessionOutput.seqNumber, SessionOutput.pid,
+      (long long)offset, (long long)length);
+   if (write(SessionOutput.indexFd, line, len) != len)
+      logWriteFailed();
+}
+
+// sendRegion()
+// - copy len bytes of the log starting at offset to outf
+
+static void sendRegion(FILE *outf, loff_t offset, size_t len)
+{
+   while (len > 0) {
+      ssize_t n = sendfile(fileno(outf), SessionOutput.fd, &offset, len);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+         // sendfile() not supported for outf: copy via userspace
+         char buf[COPYSIZE];
+         while (len > 0) {
+            n = pread(SessionOutput.fd, buf, len < COPYSIZE ? len : COPYSIZE, offset);
+            if (n <= 0) break;
+            fwrite(buf, 1, n, outf);
+            offset += n;
+            len -= n;
+         }
+         fflush(outf);
+         return;
+      }
+      if (n <= 0)
+         return;
+      len -= n;
+   }
+}
+
+// spliceAll()
+// - move exactly len bytes out of pipe in into out
+// - if off is non-NULL, write at *off and advance it
+// - returns 0 on success, -1 if out could not take the data
+
+static int spliceAll(int in, int out, loff_t *off, size_t len)
+{
+   while (len > 0) {
+      ssize_t n = splice(in, NULL, out, off, len, SPLICE_F_MOVE);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         // e.g. out opened with O_APPEND: finish the job by hand
+         return copyAll(in, out, off, len);
+      len -= n;
+   }
+   return 0;
+}
+
+// copyAll()
+// - userspace fallback for spliceAll()
+// - always consumes len bytes from in so the pipe is left empty
+
+static int copyAll(int in, int out, loff_t *off, size_t len)
+{
+   char buf[COPYSIZE];
+   int status = 0;
+   while (len > 0) {
+      ssize_t n = read(in, buf, len < COPYSIZE ? len : COPYSIZE);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return -1;
+      if (status == 0) {
+         ssize_t w = off ? pwrite(out, buf, n, *off) : write(out, buf, n);
+         if (w != n)
+            status = -1;
+         else if (off)
+            *off += n;
+      }
+      len -= n;
+   }
+   return status;
+}
+
+// discardAll()
+// - take len bytes out of pipe in and throw them away
+
+static void discardAll(int in, size_t len)
+{
+   char buf[COPYSIZE];
+   while (len > 0) {
+      ssize_t n = read(in, buf, len < COPYSIZE ? len : COPYSIZE);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return;
+      len -= n;
+   }
+}
+
+// logWriteFailed()
+// - print an error the first time output could not be logged
+
+static void logWriteFailed(void)
+{
+   if (!SessionOutput.writeFailed)
+      perror("Output log: write failed");
+   SessionOutput.writeFailed = 1;
+}
+
+// mallocMemoryCheck()
+// - print error message if malloc failed to allocate memory i.e. NULL
+
+static void mallocMemoryCheck(void *ptr)
+{
+   if (ptr == NULL) {
+      fprintf(stderr, "Failed to allocate memory using malloc.\n");
+      exit(0);
+   }
+}
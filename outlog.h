@@ -0,0 +1,16 @@
+// COMP1521 18s2 mymysh ... session output log
+// Implements an interface to an abstract data object
+
+#include <stdio.h>
+
+// Functions on the Output Log object
+
+int initOutputLog();
+int outputLogEnabled();
+int openOutputCapture(int *writeFd);
+int pumpOutputCapture(int readFd, int termFd);
+int discardOutputCapture(int readFd);
+void beginOutputEntry(int seqNo);
+void endOutputEntry();
+int showOutput(int seqNo, FILE *outf);
+void cleanOutputLog();
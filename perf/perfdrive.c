@@ -0,0 +1,250 @@
+// perfdrive.c ... run a shell workload and report its cost
+// Used by "make perf" to compare mymysh against other shells
+//
+// perfdrive [-n name] shell script
+//    feed script to shell on stdin and report commands/sec and peak RSS
+// perfdrive [-n name] -l count shell
+//    type count probe commands into shell one at a time and report
+//    the p50/p99 latency from writing a line to the command running
+// perfdrive -p fifo
+//    probe mode: signal the driver through fifo and exit
+//
+// Peak RSS is the shell's own VmHWM, read from /proc once a final
+// probe shows it has run every command but before its stdin is
+// closed. (ru_maxrss from wait4() would also cover the commands.)
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// Function forward references
+
+pid_t spawnShell(char *, int *);
+int runProbe(int, char *, char *, int, int);
+long shellPeakRSS(pid_t);
+int countCommands(char *);
+double now(void);
+int cmpDouble(const void *, const void *);
+void report(char *, char *, int, double, double *, int, long);
+void errorExit(char *);
+void usage(void);
+
+
+// Global Constants
+
+#define PROBE_TIMEOUT 10000   // ms to wait for a probe before giving up
+
+
+int main(int argc, char *argv[])
+{
+   char *name = "workload";   // workload label for the report
+   int latency = 0;           // number of probes, 0 for throughput mode
+   int opt;
+
+   while ((opt = getopt(argc, argv, "n:l:p:")) != -1) {
+      switch (opt) {
+      case 'n': name = optarg; break;
+      case 'l': latency = atoi(optarg); break;
+      case 'p': {
+         // probe mode: a single byte tells the driver we are running
+         int fd = open(optarg, O_WRONLY);
+         if (fd < 0 || write(fd, "p", 1) != 1)
+            return EXIT_FAILURE;
+         return EXIT_SUCCESS;
+      }
+      default: usage();
+      }
+   }
+   if (optind >= argc || (!latency && optind+2 != argc))
+      usage();
+   char *shell = argv[optind];
+
+   int stat;           // exit status of the shell
+   long maxrss;        // shell's peak RSS in KB, -1 if unknown
+   pid_t pid;
+   double start, secs;
+
+   // probes report back through a fifo
+   char self[4096];
+   ssize_t n = readlink("/proc/self/exe", self, sizeof(self)-1);
+   if (n < 0) errorExit("readlink() failed");
+   self[n] = '\0';
+   char fifo[] = "/tmp/perfdriveXXXXXX";
+   if (mkdtemp(fifo) == NULL) errorExit("mkdtemp() failed");
+   char fifoPath[sizeof(fifo) + 8];
+   snprintf(fifoPath, sizeof(fifoPath), "%s/fifo", fifo);
+   if (mkfifo(fifoPath, 0600) < 0) errorExit("mkfifo() failed");
+   // O_RDWR so neither side blocks in open()
+   int probe = open(fifoPath, O_RDWR);
+   if (probe < 0) errorExit(fifoPath);
+
+   int toShell;
+   if (!latency) {
+      // throughput mode: copy the whole script to the shell's stdin,
+      // then wait for one probe to know it has run every command
+      char *script = argv[optind+1];
+      int in = open(script, O_RDONLY);
+      if (in < 0) errorExit(script);
+      int ncmds = countCommands(script);
+      char buf[BUFSIZ];
+      ssize_t n;
+      start = now();
+      pid = spawnShell(shell, &toShell);
+      while ((n = read(in, buf, sizeof(buf))) > 0)
+         if (write(toShell, buf, n) != n) errorExit("write() failed");
+      close(in);
+      maxrss = -1;
+      if (runProbe(toShell, self, fifoPath, probe, -1))
+         maxrss = shellPeakRSS(pid);
+      close(toShell);
+      if (waitpid(pid, &stat, 0) < 0) errorExit("waitpid() failed");
+      secs = now() - start;
+      report(name, shell, ncmds, secs, NULL, 0, maxrss);
+   } else {
+      // latency mode: time each probe from typing it to it running
+      double *lat = malloc(latency * sizeof(double));
+      if (lat == NULL) errorExit("malloc() failed");
+      start = now();
+      pid = spawnShell(shell, &toShell);
+      int i;
+      for (i = 0; i < latency; i++) {
+         double t0 = now();
+         if (!runProbe(toShell, self, fifoPath, probe, PROBE_TIMEOUT)) {
+            fprintf(stderr, "%s: probe %d did not run\n", shell, i);
+            break;
+         }
+         lat[i] = now() - t0;
+      }
+      maxrss = shellPeakRSS(pid);
+      close(toShell);
+      if (waitpid(pid, &stat, 0) < 0) errorExit("waitpid() failed");
+      secs = now() - start;
+      report(name, shell, i, secs, lat, i, maxrss);
+      free(lat);
+   }
+
+   close(probe);
+   unlink(fifoPath);
+   rmdir(fifo);
+   return EXIT_SUCCESS;
+}
+
+// spawnShell: start shell with its output discarded
+// - stdin comes from a new pipe returned in *toShell
+pid_t spawnShell(char *shell, int *toShell)
+{
+   int p[2];
+   if (pipe(p) < 0) errorExit("pipe() failed");
+   pid_t pid = fork();
+   if (pid < 0) errorExit("fork() failed");
+   if (pid == 0) {
+      int null = open("/dev/null", O_WRONLY);
+      if (dup2(p[0], 0) < 0 || dup2(null, 1) < 0 || dup2(null, 2) < 0)
+         errorExit("dup2() failed");
+      close(p[0]);
+      close(p[1]);
+      execlp(shell, shell, (char *)NULL);
+      _exit(127);
+   }
+   close(p[0]);
+   *toShell = p[1];
+   return pid;
+}
+
+// runProbe: type a probe command into the shell and wait for it to run
+// - timeout is in ms, -1 to wait as long as it takes
+// - returns 1 if the probe ran, 0 otherwise
+int runProbe(int toShell, char *self, char *fifoPath, int probe, int timeout)
+{
+   char c;
+   struct pollfd pfd = { .fd = probe, .events = POLLIN };
+   dprintf(toShell, "%s -p %s\n", self, fifoPath);
+   return poll(&pfd, 1, timeout) > 0 && read(probe, &c, 1) == 1;
+}
+
+// shellPeakRSS: read the shell's peak RSS (VmHWM) in KB from /proc
+// - returns -1 if it cannot be read
+long shellPeakRSS(pid_t pid)
+{
+   char path[64], line[256];
+   long kb = -1;
+   snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+   FILE *fp = fopen(path, "r");
+   if (fp == NULL) return -1;
+   while (fgets(line, sizeof(line), fp) != NULL)
+      if (sscanf(line, "VmHWM: %ld", &kb) == 1) break;
+   fclose(fp);
+   return kb;
+}
+
+// countCommands: count the non-empty lines in a script
+int countCommands(char *script)
+{
+   FILE *fp = fopen(script, "r");
+   int c, prev = '\n', n = 0;
+   if (fp == NULL) errorExit(script);
+   while ((c = getc(fp)) != EOF) {
+      if (prev == '\n' && c != '\n') n++;
+      prev = c;
+   }
+   fclose(fp);
+   return n;
+}
+
+// now: monotonic time in seconds
+double now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// cmpDouble: qsort() comparison for doubles
+int cmpDouble(const void *a, const void *b)
+{
+   double x = *(const double *)a, y = *(const double *)b;
+   return (x > y) - (x < y);
+}
+
+// report: print one result line
+// - latencies are printed in microseconds, "-" if not measured
+// - maxrss is printed in KB, "-" if not measured
+void report(char *name, char *shell, int ncmds, double secs, double *lat, int nlat, long maxrss)
+{
+   char p50[32] = "-", p99[32] = "-", rss[32] = "-";
+   char *base = strrchr(shell, '/');
+   if (base != NULL) shell = base+1;
+   if (nlat > 0) {
+      qsort(lat, nlat, sizeof(double), cmpDouble);
+      snprintf(p50, sizeof(p50), "%.1f", lat[nlat/2] * 1e6);
+      snprintf(p99, sizeof(p99), "%.1f", lat[(nlat*99)/100] * 1e6);
+   }
+   if (maxrss >= 0)
+      snprintf(rss, sizeof(rss), "%ld", maxrss);
+   printf("%-10s %-8s %8d %9.3f %10.1f %10s %10s %10s\n",
+      name, shell, ncmds, secs, secs > 0 ? ncmds/secs : 0.0, p50, p99, rss);
+}
+
+// errorExit: print error message and exits the program
+void errorExit(char *msg)
+{
+   perror(msg);
+   exit(EXIT_FAILURE);
+}
+
+// usage: print usage message and exit
+void usage(void)
+{
+   fprintf(stderr, "Usage: perfdrive [-n name] shell script\n"
+                   "       perfdrive [-n name] -l count shell\n"
+                   "       perfdrive -p fifo\n");
+   exit(EXIT_FAILURE);
+}
@@ -0,0 +1,99 @@
+#!/bin/sh
+# run.sh ... end-to-end throughput comparison of mymysh, dash and bash
+# Run via "make perf" from the top-level directory
+#
+# Every workload is a plain script of simple commands, so the same
+# file can be fed to each shell on stdin. Sizes can be tuned with
+#   PERF_N       number of /bin/true and probe commands   (2000)
+#   PERF_HIST    length of the long history session      (5000)
+#   PERF_BIGMB   size of the file used for < redirection  (16)
+#   PERF_FILES   number of files matched by the wildcard  (2000)
+#   PERF_SHELLS  shells to compare                  (mymysh dash bash)
+#
+# maxrss_kb is the shell's own peak RSS (VmHWM), not its commands'
+
+set -e
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+drive="$top/perf/perfdrive"
+N=${PERF_N:-2000}
+HIST=${PERF_HIST:-5000}
+BIGMB=${PERF_BIGMB:-16}
+FILES=${PERF_FILES:-2000}
+SHELLS=${PERF_SHELLS:-"mymysh dash bash"}
+
+work=$(mktemp -d /tmp/mymysh-perf.XXXXXX)
+trap 'rm -rf "$work"' EXIT INT TERM
+
+# keep mymysh's history file and output log out of the user's home
+HOME=$work
+export HOME
+unset MYMYSH_OUTLOG
+
+TRUE=$(command -v true)
+ECHO=$(command -v echo)
+CKSUM=$(command -v cksum)
+case "$TRUE" in /*) ;; *) TRUE=/bin/true ;; esac
+case "$ECHO" in /*) ;; *) ECHO=/bin/echo ;; esac
+
+# build the workloads
+
+i=0
+while [ $i -lt "$N" ]; do echo "$TRUE"; i=$((i+1)); done > "$work/true.sh"
+
+head -c $((BIGMB*1024*1024)) /dev/urandom > "$work/big"
+i=0
+while [ $i -lt 20 ]; do echo "$CKSUM < $work/big"; i=$((i+1)); done > "$work/redirect.sh"
+
+mkdir "$work/files"
+i=0
+while [ $i -lt "$FILES" ]; do : > "$work/files/f$i"; i=$((i+1)); done
+i=0
+while [ $i -lt 200 ]; do echo "$ECHO $work/files/f*[0-9]"; i=$((i+1)); done > "$work/glob.sh"
+
+i=0
+while [ $i -lt "$HIST" ]; do echo "$TRUE $i"; i=$((i+1)); done > "$work/history.sh"
+
+# run each workload through each shell that is installed
+
+if command -v perf > /dev/null 2>&1 && perf stat -e task-clock true > /dev/null 2>&1; then
+   PERFSTAT=1
+else
+   PERFSTAT=
+fi
+
+printf "%-10s %-8s %8s %9s %10s %10s %10s %10s\n" \
+   workload shell cmds secs cmds/sec p50_us p99_us maxrss_kb
+
+run()
+{
+   name=$1; shift
+   rm -f "$HOME/.mymysh_history"
+   if [ -n "$PERFSTAT" ]; then
+      perf stat -x, -o "$work/$name.$sh.stat" \
+         -e task-clock,context-switches,page-faults,cycles,instructions \
+         "$drive" -n "$name" "$@"
+   else
+      "$drive" -n "$name" "$@"
+   fi
+}
+
+for sh in $SHELLS; do
+   case "$sh" in
+   mymysh) shell="$top/mymysh" ;;
+   *) shell=$(command -v "$sh") || continue ;;
+   esac
+   for w in true redirect glob history; do
+      run "$w" "$shell" "$work/$w.sh"
+   done
+   run dispatch -l "$N" "$shell"
+done
+
+if [ -n "$PERFSTAT" ]; then
+   echo
+   echo "perf stat counters (value,unit,event):"
+   for f in "$work"/*.stat; do
+      echo "${f##*/}" | sed 's/\.stat$//'
+      grep -v '^#' "$f" | grep -v '^$' | cut -d, -f1-3 | sed 's/^/   /'
+   done
+fi
@@ -0,0 +1,295 @@
+// COMP1521 18s2 mymysh ... child process watchdog
+// Implements an abstract data object
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include "watchdog.h"
+#include "outlog.h"
+
+// Watchdog
+// runs each child in its own process group and waits for it
+// - SIGCHLD is blocked and read through a signalfd, so the shell
+//   can wait for the child, a deadline on a timerfd and captured
+//   output all at once with poll()
+// - when the deadline passes, the whole group gets SIGTERM, then
+//   SIGKILL if it is still running KILLGRACE seconds later
+// - there is no job control to resume a stopped child (e.g. after ^Z),
+//   so a stopped group is continued and terminated the same way
+
+#define KILLGRACE 2.0
+#define MAXTIMEOUT (366.0*24*60*60)   // longest time limit accepted
+
+typedef struct _watchdog {
+   int sigFd;            // signalfd for SIGCHLD
+   int timerFd;          // timerfd for the current deadline
+   int terminal;         // 1 if the shell owns the terminal
+   double defaultTimeout;   // seconds, 0 for no limit
+   sigset_t oldMask;     // signal mask to restore in children
+} Watchdog;
+
+// Helper Function prototypes
+static void armTimer(double);
+static void terminateGroup(pid_t, int *);
+static int pumpCapture(int *, int, int *);
+
+
+Watchdog ChildWatchdog = { .sigFd = -1, .timerFd = -1 };
+
+// initWatchdog()
+// - block SIGCHLD and set up the descriptors used by waitForChild()
+// - returns 0 on success, -1 on failure
+
+int initWatchdog()
+{
+   sigset_t mask;
+
+   sigemptyset(&mask);
+   sigaddset(&mask, SIGCHLD);
+   if (sigprocmask(SIG_BLOCK, &mask, &ChildWatchdog.oldMask) < 0)
+      return -1;
+   ChildWatchdog.sigFd = signalfd(-1, &mask, SFD_CLOEXEC);
+   ChildWatchdog.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+   if (ChildWatchdog.sigFd < 0 || ChildWatchdog.timerFd < 0)
+      return -1;
+
+   // the shell hands the terminal to each child's process group,
+   // and needs to ignore SIGTTOU to take it back afterwards
+   ChildWatchdog.terminal = isatty(STDIN_FILENO) && tcgetpgrp(STDIN_FILENO) == getpgrp();
+   if (ChildWatchdog.terminal)
+      signal(SIGTTOU, SIG_IGN);
+   ChildWatchdog.defaultTimeout = 0;
+   return 0;
+}
+
+// parseDuration()
+// - convert a duration such as "10", "1.5s", "250ms", "2m" or "1h" to seconds
+// - returns 0 on success, -1 if str is not a valid duration
+//   or is longer than MAXTIMEOUT
+
+int parseDuration(char *str, double *secs)
+{
+   char *unit;
+   double d = strtod(str, &unit);
+
+   // strtod() also takes "inf", "nan" and values too big for a timer
+   if (unit == str || !isfinite(d) || d < 0 || d > MAXTIMEOUT)
+      return -1;
+   if (strcmp(unit, "") == 0 || strcmp(unit, "s") == 0)
+      *secs = d;
+   else if (strcmp(unit, "ms") == 0)
+      *secs = d / 1000;
+   else if (strcmp(unit, "m") == 0)
+      *secs = d * 60;
+   else if (strcmp(unit, "h") == 0)
+      *secs = d * 60 * 60;
+   else
+      return -1;
+   return (*secs > MAXTIMEOUT) ? -1 : 0;
+}
+
+// setDefaultTimeout()
+// - set the time limit for commands run without "timeout", 0 for none
+
+void setDefaultTimeout(double secs)
+{
+   ChildWatchdog.defaultTimeout = secs;
+}
+
+// getDefaultTimeout()
+// - returns the time limit for commands run without "timeout"
+
+double getDefaultTimeout()
+{
+   return ChildWatchdog.defaultTimeout;
+}
+
+// prepareWatchedChild()
+// - called in the child after fork()
+// - move into a new process group and restore the signal state
+
+void prepareWatchedChild()
+{
+   setpgid(0, 0);
+   if (ChildWatchdog.terminal)
+      tcsetpgrp(STDIN_FILENO, getpid());
+   signal(SIGTTOU, SIG_DFL);
+   sigprocmask(SIG_SETMASK, &ChildWatchdog.oldMask, NULL);
+}
+
+// waitForChild()
+// - wait for child pid to finish, copying its captured stdout and
+//   stderr from outFd and errFd (-1 if not captured) while it runs
+// - once it exits, only output already in the pipe is copied, so a
+//   background process still holding the pipe cannot keep us waiting
+// - if timeout is non-zero, kill the child's group once it passes
+// - stores the child's status in *stat
+// - returns the last signal sent on timeout, 0 if it did not time out
+
+int waitForChild(pid_t pid, double timeout, int outFd, int errFd, int *stat)
+{
+   int killSig = 0;   // last signal sent to the group
+   int timedOut = 0;  // 1 if the deadline passed
+   int reaped = 0;    // 1 once the child has been waited for
+   int status;        // status from waitpid()
+   pid_t w;
+   struct signalfd_siginfo si;
+   uint64_t expired;
+
+   // also done in the child: whichever runs first wins the race
+   setpgid(pid, pid);
+   if (ChildWatchdog.terminal)
+      tcsetpgrp(STDIN_FILENO, pid);
+   if (timeout > 0)
+      armTimer(timeout);
+
+   int capFd[2] = { outFd, errFd };
+   int termFd[2] = { STDOUT_FILENO, STDERR_FILENO };
+   int discard[2] = { 0, 0 };   // 1 once a pipe can no longer be copied
+
+   while (!reaped) {
+      // poll() skips entries whose fd is -1
+      struct pollfd fds[4] = {
+         { .fd = ChildWatchdog.sigFd, .events = POLLIN },
+         { .fd = ChildWatchdog.timerFd, .events = POLLIN },
+         { .fd = capFd[0], .events = POLLIN },
+         { .fd = capFd[1], .events = POLLIN },
+      };
+      if (poll(fds, 4, -1) < 0) {
+         if (errno == EINTR) continue;
+         // cannot watch the child any more: kill it and reap it
+         // rather than leave it running with the terminal
+         perror("poll() failed");
+         killSig = SIGKILL;
+         killpg(pid, SIGKILL);
+         killpg(pid, SIGCONT);
+         while ((w = waitpid(pid, &status, 0)) < 0 && errno == EINTR)
+            ;
+         *stat = (w == pid) ? status : W_EXITCODE(0, SIGKILL);
+         reaped = 1;
+         break;
+      }
+      // captured output: stop capturing at end of output
+      for (int i = 0; i < 2; i++)
+         if (capFd[i] >= 0 && fds[2+i].revents != 0)
+            pumpCapture(&capFd[i], termFd[i], &discard[i]);
+      // child exited or stopped
+      // - signals coalesce, so collect every change of state
+      if (fds[0].revents & POLLIN) {
+         if (read(ChildWatchdog.sigFd, &si, sizeof(si)) < 0) { /* coalesced */ }
+         while (!reaped && (w = waitpid(pid, &status, WNOHANG | WUNTRACED)) == pid) {
+            if (!WIFSTOPPED(status)) {
+               *stat = status;
+               reaped = 1;
+            } else if (killSig == 0) {
+               // take the terminal back so the prompt is usable
+               if (ChildWatchdog.terminal)
+                  tcsetpgrp(STDIN_FILENO, getpgrp());
+               printf("\nStopped: no job control, terminating %d\n", (int)pid);
+               fflush(stdout);
+               terminateGroup(pid, &killSig);
+            } else {
+               // stopped again while being terminated
+               killpg(pid, SIGCONT);
+            }
+         }
+      }
+      // deadline passed: TERM first, then KILL after the grace period
+      if (fds[1].revents & POLLIN) {
+         if (read(ChildWatchdog.timerFd, &expired, sizeof(expired)) < 0) { /* spurious */ }
+         if (killSig == 0)
+            timedOut = 1;
+         terminateGroup(pid, &killSig);
+      }
+   }
+
+   // copy what the child left in the pipes, without waiting for more
+   for (int i = 0; i < 2; i++) {
+      while (capFd[i] >= 0) {
+         struct pollfd fds = { .fd = capFd[i], .events = POLLIN };
+         if (poll(&fds, 1, 0) <= 0 || pumpCapture(&capFd[i], termFd[i], &discard[i]) <= 0)
+            break;
+      }
+   }
+
+   armTimer(0);
+   if (ChildWatchdog.terminal)
+      tcsetpgrp(STDIN_FILENO, getpgrp());
+   return timedOut ? killSig : 0;
+}
+
+// cleanWatchdog()
+// - close the watchdog's descriptors
+
+void cleanWatchdog()
+{
+   if (ChildWatchdog.sigFd >= 0)
+      close(ChildWatchdog.sigFd);
+   if (ChildWatchdog.timerFd >= 0)
+      close(ChildWatchdog.timerFd);
+   ChildWatchdog.sigFd = ChildWatchdog.timerFd = -1;
+}
+
+// Helper Functions
+
+// terminateGroup()
+// - send group pid the next signal after *killSig: SIGTERM, then SIGKILL
+// - the group is also continued, in case it is stopped
+// - after SIGTERM, the timer is set to send SIGKILL after KILLGRACE
+
+static void terminateGroup(pid_t pid, int *killSig)
+{
+   *killSig = (*killSig == 0) ? SIGTERM : SIGKILL;
+   killpg(pid, *killSig);
+   killpg(pid, SIGCONT);
+   if (*killSig == SIGTERM)
+      armTimer(KILLGRACE);
+}
+
+// pumpCapture()
+// - copy the next chunk of output from capture pipe *capFd to termFd
+// - if it cannot be copied, *discard is set and from then on the
+//   pipe is read and thrown away, so the child never blocks on it
+// - *capFd is set to -1 at end of output, or if the pipe cannot
+//   be read at all
+// - returns number of bytes read, 0 at end of output, -1 on error
+
+static int pumpCapture(int *capFd, int termFd, int *discard)
+{
+   int n;
+
+   if (!*discard && (n = pumpOutputCapture(*capFd, termFd)) >= 0) {
+      if (n == 0)
+         *capFd = -1;
+      return n;
+   }
+   *discard = 1;
+   if ((n = discardOutputCapture(*capFd)) == 0
+         || (n < 0 && errno != EINTR && errno != EAGAIN))
+      *capFd = -1;
+   return n;
+}
+
+// armTimer()
+// - make the timerfd expire once after secs seconds, 0 to disarm
+
+static void armTimer(double secs)
+{
+   struct itimerspec its;
+   memset(&its, 0, sizeof(its));
+   its.it_value.tv_sec = (time_t)secs;
+   its.it_value.tv_nsec = (long)((secs - (time_t)secs) * 1e9);
+   // a zero it_value would disarm, so round tiny limits up
+   if (secs > 0 && its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+      its.it_value.tv_nsec = 1;
+   timerfd_settime(ChildWatchdog.timerFd, 0, &its, NULL);
+}
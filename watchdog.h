@@ -0,0 +1,14 @@
+// COMP1521 18s2 mymysh ... child process watchdog
+// Implements an interface to an abstract data object
+
+#include <sys/types.h>
+
+// Functions on the Watchdog object
+
+int initWatchdog();
+int parseDuration(char *str, double *secs);
+void setDefaultTimeout(double secs);
+double getDefaultTimeout();
+void prepareWatchedChild();
+int waitForChild(pid_t pid, double timeout, int outFd, int errFd, int *stat);
+void cleanWatchdog();
@@ -0,0 +1,265 @@
+// COMP1521 18s2 mymysh ... working directory
+// Implements an abstract data object
+
+// O_PATH is only available with _GNU_SOURCE
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "workdir.h"
+
+// Working Directory
+// the shell's idea of its current directory, kept as a logical
+// path plus an open descriptor, so that neither has to be
+// re-derived with getcwd() after every cd
+// also holds the pushd/popd directory stack
+
+#define DIROPEN (O_PATH | O_DIRECTORY | O_CLOEXEC)
+
+typedef struct _working_dir {
+   char *path;          // logical absolute path of the cwd
+   char *oldPath;       // previous cwd, NULL if never changed
+   int   fd;            // descriptor open on the cwd
+   int   nDirs;         // entries on the directory stack
+   int   maxDirs;
+   char **dirs;         // directory stack, top is dirs[nDirs-1]
+} WorkingDir;
+
+// Helper Function prototypes
+static char *joinPath(char *, char *);
+static void normalisePath(char *);
+static int hasDotDot(char *);
+static void mallocMemoryCheck(void *);
+
+
+WorkingDir CurrentDir = { .fd = -1 };
+
+// initWorkingDir()
+// - record the directory the shell started in
+// - prefer $PWD, which keeps symlinks, if it names the same directory
+// - returns 0 on success, -1 if the cwd could not be found
+
+int initWorkingDir()
+{
+   struct stat dot, pwd;
+   char *env = getenv("PWD");
+
+   if ((CurrentDir.fd = open(".", DIROPEN)) < 0)
+      return -1;
+   if (env != NULL && env[0] == '/' && fstat(CurrentDir.fd, &dot) == 0
+         && stat(env, &pwd) == 0
+         && dot.st_dev == pwd.st_dev && dot.st_ino == pwd.st_ino) {
+      CurrentDir.path = strdup(env);
+      mallocMemoryCheck(CurrentDir.path);
+      normalisePath(CurrentDir.path);
+   } else if ((CurrentDir.path = getcwd(NULL, 0)) == NULL) {
+      return -1;
+   }
+   CurrentDir.oldPath = NULL;
+   CurrentDir.nDirs = CurrentDir.maxDirs = 0;
+   CurrentDir.dirs = NULL;
+   return 0;
+}
+
+// getWorkingDir()
+// - returns the logical path of the cwd
+
+char *getWorkingDir()
+{
+   return CurrentDir.path;
+}
+
+// getOldWorkingDir()
+// - returns the previous cwd, or NULL if there is none
+
+char *getOldWorkingDir()
+{
+   return CurrentDir.oldPath;
+}
+
+// getWorkingDirFd()
+// - returns a descriptor on the cwd for use with the *at() calls
+
+int getWorkingDirFd()
+{
+   return CurrentDir.fd;
+}
+
+// changeWorkingDir()
+// - change to path, relative to the cwd unless absolute
+// - ".." is resolved logically, as a shell user expects after
+//   following a symlink, everything else relative to the cached fd
+// - returns 0 on success, -1 on failure with errno set
+
+int changeWorkingDir(char *path)
+{
+   char *target = joinPath(CurrentDir.path, path);
+   int fd;
+
+   normalisePath(target);
+   if (hasDotDot(path)) {
+      fd = open(target, DIROPEN);
+      // logical path too long to open in one go: go physical
+      if (fd < 0 && errno == ENAMETOOLONG)
+         fd = openat(CurrentDir.fd, path, DIROPEN);
+   } else {
+      fd = openat(CurrentDir.fd, path, DIROPEN);
+   }
+   if (fd < 0 || fchdir(fd) < 0) {
+      int err = errno;
+      if (fd >= 0) close(fd);
+      free(target);
+      errno = err;
+      return -1;
+   }
+
+   close(CurrentDir.fd);
+   CurrentDir.fd = fd;
+   free(CurrentDir.oldPath);
+   CurrentDir.oldPath = CurrentDir.path;
+   CurrentDir.path = target;
+   return 0;
+}
+
+// pushWorkingDir()
+// - change to path and push the old cwd onto the directory stack
+// - if path is NULL, exchange the cwd with the top of the stack
+// - returns 0 on success, -1 if the change failed, -2 if the stack is empty
+
+int pushWorkingDir(char *path)
+{
+   if (path == NULL) {
+      if (CurrentDir.nDirs == 0)
+         return -2;
+      char *top = CurrentDir.dirs[CurrentDir.nDirs-1];
+      if (changeWorkingDir(top) < 0)
+         return -1;
+      CurrentDir.dirs[CurrentDir.nDirs-1] = strdup(CurrentDir.oldPath);
+      mallocMemoryCheck(CurrentDir.dirs[CurrentDir.nDirs-1]);
+      free(top);
+      return 0;
+   }
+
+   if (changeWorkingDir(path) < 0)
+      return -1;
+   if (CurrentDir.nDirs == CurrentDir.maxDirs) {
+      CurrentDir.maxDirs = CurrentDir.maxDirs ? 2*CurrentDir.maxDirs : 8;
+      CurrentDir.dirs = realloc(CurrentDir.dirs, CurrentDir.maxDirs*sizeof(char *));
+      mallocMemoryCheck(CurrentDir.dirs);
+   }
+   CurrentDir.dirs[CurrentDir.nDirs] = strdup(CurrentDir.oldPath);
+   mallocMemoryCheck(CurrentDir.dirs[CurrentDir.nDirs]);
+   CurrentDir.nDirs++;
+   return 0;
+}
+
+// popWorkingDir()
+// - pop the top of the directory stack and change to it
+// - returns 0 on success, -1 if the change failed, -2 if the stack is empty
+
+int popWorkingDir()
+{
+   if (CurrentDir.nDirs == 0)
+      return -2;
+   if (changeWorkingDir(CurrentDir.dirs[CurrentDir.nDirs-1]) < 0)
+      return -1;
+   free(CurrentDir.dirs[--CurrentDir.nDirs]);
+   return 0;
+}
+
+// showDirStack()
+// - display the cwd followed by the directory stack, top first
+
+void showDirStack(FILE *outf)
+{
+   fprintf(outf, "%s", CurrentDir.path);
+   for (int i = CurrentDir.nDirs-1; i >= 0; i--)
+      fprintf(outf, " %s", CurrentDir.dirs[i]);
+   fprintf(outf, "\n");
+}
+
+// cleanWorkingDir()
+// - release all data allocated to the working directory
+
+void cleanWorkingDir()
+{
+   for (int i = 0; i < CurrentDir.nDirs; i++)
+      free(CurrentDir.dirs[i]);
+   free(CurrentDir.dirs);
+   free(CurrentDir.path);
+   free(CurrentDir.oldPath);
+   if (CurrentDir.fd >= 0)
+      close(CurrentDir.fd);
+}
+
+// Helper Functions
+
+// joinPath()
+// - returns a newly allocated path for path relative to dir
+
+static char *joinPath(char *dir, char *path)
+{
+   char *joined;
+   if (path[0] == '/') {
+      joined = strdup(path);
+   } else {
+      joined = malloc(strlen(dir) + strlen(path) + 2);
+      mallocMemoryCheck(joined);
+      sprintf(joined, "%s/%s", dir, path);
+   }
+   mallocMemoryCheck(joined);
+   return joined;
+}
+
+// normalisePath()
+// - remove empty, "." and ".." components from an absolute path in place
+
+static void normalisePath(char *path)
+{
+   char *src = path, *dst = path;
+   while (*src != '\0') {
+      while (*src == '/') src++;
+      if (*src == '\0') break;
+      char *end = strchr(src, '/');
+      size_t len = end ? end - src : strlen(src);
+      if (len == 2 && src[0] == '.' && src[1] == '.') {
+         // drop the last component written, but never go above "/"
+         while (dst > path && *--dst != '/')
+            ;
+      } else if (!(len == 1 && src[0] == '.')) {
+         *dst++ = '/';
+         memmove(dst, src, len);
+         dst += len;
+      }
+      src += len;
+   }
+   if (dst == path) *dst++ = '/';
+   *dst = '\0';
+}
+
+// hasDotDot()
+// - return 1 if path has a ".." component, 0 otherwise
+
+static int hasDotDot(char *path)
+{
+   for (char *s = path; (s = strstr(s, "..")) != NULL; s += 2)
+      if ((s == path || s[-1] == '/') && (s[2] == '\0' || s[2] == '/'))
+         return 1;
+   return 0;
+}
+
+// mallocMemoryCheck()
+// - print error message if malloc failed to allocate memory i.e. NULL
+
+static void mallocMemoryCheck(void *ptr)
+{
+   if (ptr == NULL) {
+      fprintf(stderr, "Failed to allocate memory using malloc.\n");
+      exit(0);
+   }
+}
@@ -0,0 +1,16 @@
+// COMP1521 18s2 mymysh ... working directory
+// Implements an interface to an abstract data object
+
+#include <stdio.h>
+
+// Functions on the Working Directory object
+
+int initWorkingDir();
+char *getWorkingDir();
+char *getOldWorkingDir();
+int getWorkingDirFd();
+int changeWorkingDir(char *path);
+int pushWorkingDir(char *path);
+int popWorkingDir();
+void showDirStack(FILE *outf);
+void cleanWorkingDir();